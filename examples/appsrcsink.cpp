@@ -1,3 +1,4 @@
+#include <string_view>
 #include <vector>
 
 #include <gst/app/gstappsink.h>
@@ -6,9 +7,11 @@
 #include <gst/video/gstvideodecoder.h>
 
 #include "gstutil/auto-gst-object.hpp"
+#include "gstutil/latency-tracer.hpp"
 #include "gstutil/pipeline-helper.hpp"
 #include "macros/autoptr.hpp"
 #include "macros/unwrap.hpp"
+#include "util/charconv.hpp"
 
 namespace {
 declare_autoptr(GstBuffer, GstBuffer, gst_buffer_unref);
@@ -16,14 +19,15 @@ declare_autoptr(GstCaps, GstCaps, gst_caps_unref);
 declare_autoptr(GstSample, GstSample, gst_sample_unref);
 
 auto appsrc   = (GstElement*)(nullptr);
+auto tracer   = (LatencyTracer*)(nullptr);
 auto caps_str = R"caps(application/x-rtp, media=(string)video, clock-rate=(int)90000, encoding-name=(string)H264, packetization-mode=(string)1, sprop-parameter-sets=(string)"Z/QADZGbKCg/YC1BgYGQAAADABAAAAMDyPFCmWA\=\,aOvsRIRA", profile-level-id=(string)f4000d, profile=(string)high-4:4:4, payload=(int)96, ssrc=(uint)3758284032, timestamp-offset=(uint)417728509, seqnum-offset=(uint)23687, a-framerate=(string)30)caps";
 
 auto on_new_sample(GstAppSink* const appsink, const gpointer /*data*/) -> GstFlowReturn {
+    // kept until the push, to carry the latency stamp over
+    auto sample  = AutoGstSample(gst_app_sink_pull_sample(appsink));
     auto payload = std::vector<std::byte>();
     // pull
     {
-        auto sample = AutoGstSample(gst_app_sink_pull_sample(appsink));
-
         static auto first = true;
         if(first) {
             auto caps = AutoGstCaps(gst_sample_get_caps(sample.get()));
@@ -46,16 +50,21 @@ auto on_new_sample(GstAppSink* const appsink, const gpointer /*data*/) -> GstFlo
         payload.resize(info.size);
         memcpy(info.data, payload.data(), payload.size());
         gst_buffer_unmap(buffer.get(), &info);
+        tracer->copy_stamp(gst_sample_get_buffer(sample.get()), buffer.get());
 
         gst_app_src_push_buffer(GST_APP_SRC(appsrc), buffer.release());
     }
 
     return GST_FLOW_OK;
 }
-} // namespace
 
-auto main(int argc, char* argv[]) -> int {
-    gst_init(&argc, &argv);
+auto on_eos(GstAppSink* const /*appsink*/, const gpointer /*data*/) -> void {
+    gst_app_src_end_of_stream(GST_APP_SRC(appsrc));
+}
+
+auto run_appsrcsink_example(const bool headless, const int budget_ms) -> bool {
+    auto latency_tracer = LatencyTracer();
+    ::tracer            = &latency_tracer;
 
     const auto pipeline = AutoGstObject(gst_pipeline_new(NULL));
     ensure(pipeline.get() != NULL);
@@ -63,11 +72,19 @@ auto main(int argc, char* argv[]) -> int {
     // sender
     unwrap_mut(videotestsrc, add_new_element_to_pipeline(pipeline.get(), "videotestsrc"));
     g_object_set(&videotestsrc, "is-live", TRUE, NULL);
+    if(headless) {
+        g_object_set(&videotestsrc, "num-buffers", 300, NULL);
+    }
     unwrap_mut(x264enc, add_new_element_to_pipeline(pipeline.get(), "x264enc"));
+    if(headless) {
+        // without lookahead and b-frames, so that the budget checks the pipeline rather than the encoder buffering
+        gst_util_set_object_arg(G_OBJECT(&x264enc), "tune", "zerolatency");
+    }
     unwrap_mut(rtph264pay, add_new_element_to_pipeline(pipeline.get(), "rtph264pay"));
     unwrap_mut(appsink, add_new_element_to_pipeline(pipeline.get(), "appsink"));
     g_object_set(&appsink, "emit-signals", TRUE, NULL);
     ensure(g_signal_connect(&appsink, "new-sample", G_CALLBACK(on_new_sample), NULL) > 0);
+    ensure(g_signal_connect(&appsink, "eos", G_CALLBACK(on_eos), NULL) > 0);
     g_object_set(&appsink, "async", FALSE, NULL);
 
     ensure(gst_element_link_pads(&videotestsrc, NULL, &x264enc, NULL) == TRUE);
@@ -83,17 +100,71 @@ auto main(int argc, char* argv[]) -> int {
     unwrap_mut(rtph264depay, add_new_element_to_pipeline(pipeline.get(), "rtph264depay"));
     unwrap_mut(avdec_h264, add_new_element_to_pipeline(pipeline.get(), "avdec_h264"));
     unwrap_mut(videoconvert, add_new_element_to_pipeline(pipeline.get(), "videoconvert"));
-    unwrap_mut(waylandsink, add_new_element_to_pipeline(pipeline.get(), "waylandsink"));
-    g_object_set(&waylandsink, "async", FALSE, NULL);
-    g_object_set(&waylandsink, "sync", FALSE, NULL);
+    unwrap_mut(videosink, add_new_element_to_pipeline(pipeline.get(), headless ? "fakesink" : "waylandsink"));
+    g_object_set(&videosink, "async", FALSE, NULL);
+    g_object_set(&videosink, "sync", FALSE, NULL);
     ensure(gst_element_link_pads_filtered(&appsrc, NULL, &rtph264depay, NULL, payload_caps.get()) == TRUE);
     ensure(gst_element_link_pads(&rtph264depay, NULL, &avdec_h264, NULL) == TRUE);
     ensure(gst_element_link_pads(&avdec_h264, NULL, &videoconvert, NULL) == TRUE);
-    ensure(gst_element_link_pads(&videoconvert, NULL, &waylandsink, NULL) == TRUE);
+    ensure(gst_element_link_pads(&videoconvert, NULL, &videosink, NULL) == TRUE);
 
     ::appsrc = &appsrc;
 
-    ensure(run_pipeline(pipeline.get()));
+    // latency probes, in stream order
+    ensure(latency_tracer.stamp_at(&videotestsrc, "src"));
+    ensure(latency_tracer.measure_at(&x264enc, "src", "x264enc"));
+    ensure(latency_tracer.measure_at(&rtph264pay, "src", "rtph264pay"));
+    ensure(latency_tracer.measure_at(&appsrc, "src", "appsrc"));
+    ensure(latency_tracer.measure_at(&rtph264depay, "src", "rtph264depay"));
+    ensure(latency_tracer.measure_at(&avdec_h264, "src", "avdec_h264"));
+    ensure(latency_tracer.measure_at(&videosink, "sink", "sink"));
+
+    const auto ok = run_pipeline(pipeline.get());
+
+    latency_tracer.print_report();
+    ensure(ok);
+    if(headless) {
+        const auto  report = latency_tracer.collect_report();
+        const auto& e2e    = report.entries.back().total;
+        if(e2e.count == 0) {
+            PRINT("no stamped buffer reached the sink");
+            return false;
+        }
+        if(e2e.p99 > GstClockTime(budget_ms) * GST_MSECOND) {
+            PRINT("end-to-end p99 latency {}ms exceeds budget {}ms", e2e.p99 / GST_MSECOND, budget_ms);
+            return false;
+        }
+        PRINT("end-to-end p99 latency is within budget {}ms", budget_ms);
+    }
+
+    return true;
+}
+} // namespace
+
+// usage: appsrcsink [--headless [--budget-ms MS]]
+// in headless mode, a fixed number of frames are sent to fakesink and the exit status
+// reports whether the pipeline finished without error and the end-to-end p99 latency met the budget
+auto main(int argc, char* argv[]) -> int {
+    gst_init(&argc, &argv);
+
+    auto headless  = false;
+    auto budget_ms = 250;
+    for(auto i = 1; i < argc; i += 1) {
+        const auto arg = std::string_view(argv[i]);
+        if(arg == "--headless") {
+            headless = true;
+        } else if(arg == "--budget-ms" && i + 1 < argc) {
+            const auto num = from_chars<int>(argv[i += 1]);
+            if(!num || *num <= 0) {
+                PRINT("invalid budget {}", argv[i]);
+                return 1;
+            }
+            budget_ms = *num;
+        } else {
+            PRINT("unknown argument {}", arg);
+            return 1;
+        }
+    }
 
-    return 0;
+    return run_appsrcsink_example(headless, budget_ms) ? 0 : 1;
 }
@@ -0,0 +1,90 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <gst/gst.h>
+
+#include "gstutil/auto-gst-object.hpp"
+#include "gstutil/branch-supervisor.hpp"
+#include "gstutil/pipeline-helper.hpp"
+#include "macros/unwrap.hpp"
+
+namespace {
+auto inject_failure = std::atomic_bool(false);
+
+// behaves like a failing sink: posts an error and returns GST_FLOW_ERROR to the queue
+auto fault_probe_callback(GstPad* const pad, GstPadProbeInfo* const info, gpointer const /*data*/) -> GstPadProbeReturn {
+    if(!inject_failure.exchange(false)) {
+        return GST_PAD_PROBE_OK;
+    }
+    PRINT("injecting flow error");
+    const auto sink = GST_PAD_PARENT(pad);
+    GST_ELEMENT_ERROR(sink, RESOURCE, FAILED, ("injected failure"), (NULL));
+    gst_buffer_unref(GST_PAD_PROBE_INFO_BUFFER(info));
+    GST_PAD_PROBE_INFO_FLOW_RETURN(info) = GST_FLOW_ERROR;
+    return GST_PAD_PROBE_HANDLED;
+}
+
+auto build_display_branch(GstElement* const pipeline) -> std::optional<std::vector<GstElement*>> {
+    unwrap_mut(queue, add_new_element_to_pipeline(pipeline, "queue"));
+    unwrap_mut(videoconvert, add_new_element_to_pipeline(pipeline, "videoconvert"));
+    unwrap_mut(waylandsink, add_new_element_to_pipeline(pipeline, "waylandsink"));
+    g_object_set(&waylandsink, "async", FALSE, NULL);
+    const auto sink_pad = AutoGstObject<GstPad>::adopt(gst_element_get_static_pad(&waylandsink, "sink"));
+    ensure(sink_pad.get() != NULL);
+    gst_pad_add_probe(sink_pad.get(), GST_PAD_PROBE_TYPE_BUFFER, fault_probe_callback, NULL, NULL);
+    ensure(gst_element_link_pads(&queue, NULL, &videoconvert, NULL) == TRUE);
+    ensure(gst_element_link_pads(&videoconvert, NULL, &waylandsink, NULL) == TRUE);
+    return std::vector{&queue, &videoconvert, &waylandsink};
+}
+
+auto build_record_branch(GstElement* const pipeline) -> std::optional<std::vector<GstElement*>> {
+    unwrap_mut(queue, add_new_element_to_pipeline(pipeline, "queue"));
+    unwrap_mut(fakesink, add_new_element_to_pipeline(pipeline, "fakesink"));
+    g_object_set(&fakesink, "async", FALSE, NULL);
+    ensure(gst_element_link_pads(&queue, NULL, &fakesink, NULL) == TRUE);
+    return std::vector{&queue, &fakesink};
+}
+
+auto run_branch_recovery_example() -> bool {
+    // videotestsrc -> tee -+-> queue -> videoconvert -> waylandsink (display)
+    //                      +-> queue -> fakesink                    (record)
+    const auto pipeline = AutoGstObject(gst_pipeline_new(NULL));
+    ensure(pipeline.get() != NULL);
+
+    unwrap_mut(videotestsrc, add_new_element_to_pipeline(pipeline.get(), "videotestsrc"));
+    g_object_set(&videotestsrc, "is-live", TRUE, NULL);
+    unwrap_mut(tee, add_new_element_to_pipeline(pipeline.get(), "tee"));
+    g_object_set(&tee, "allow-not-linked", TRUE, NULL);
+    ensure(gst_element_link_pads(&videotestsrc, NULL, &tee, NULL) == TRUE);
+
+    auto supervisor = BranchSupervisor(pipeline.get());
+    // the supervisor takes over the request pads and releases them
+    ensure(supervisor.add_branch("display", gst_element_request_pad_simple(&tee, "src_%u"), build_display_branch));
+    ensure(supervisor.add_branch("record", gst_element_request_pad_simple(&tee, "src_%u"), build_record_branch));
+    // failing every 3 seconds makes at most 4 failures per window, below max_restarts
+    supervisor.restart_window = 10 * GST_SECOND;
+    ensure(supervisor.attach());
+
+    // make the display sink fail periodically, the record branch should keep running
+    auto stop     = std::atomic_bool(false);
+    auto injector = std::thread([&supervisor, &stop]() -> bool {
+        while(!stop) {
+            std::this_thread::sleep_for(std::chrono::seconds(3));
+            inject_failure = true;
+            supervisor.print_counters();
+        }
+        return true;
+    });
+
+    auto ret = run_pipeline(pipeline.get());
+    stop     = true;
+    injector.join();
+    return ret;
+}
+} // namespace
+
+auto main(int argc, char* argv[]) -> int {
+    gst_init(&argc, &argv);
+    return run_branch_recovery_example() ? 0 : 1;
+}
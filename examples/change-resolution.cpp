@@ -125,5 +125,5 @@ auto run_change_resolution_example() -> bool {
 
 auto main(int argc, char* argv[]) -> int {
     gst_init(&argc, &argv);
-    return run_change_resolution_example() ? 1 : 0;
+    return run_change_resolution_example() ? 0 : 1;
 }
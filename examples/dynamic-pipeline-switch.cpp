@@ -115,5 +115,5 @@ auto run_dynamic_switch_example() -> bool {
 
 auto main(int argc, char* argv[]) -> int {
     gst_init(&argc, &argv);
-    return run_dynamic_switch_example() ? 1 : 0;
+    return run_dynamic_switch_example() ? 0 : 1;
 }
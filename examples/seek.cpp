@@ -5,6 +5,7 @@
 #include <gst/gst.h>
 
 #include "gstutil/auto-gst-object.hpp"
+#include "gstutil/mmap-source.hpp"
 #include "gstutil/pipeline-helper.hpp"
 #include "macros/autoptr.hpp"
 #include "macros/unwrap.hpp"
@@ -31,6 +32,7 @@ constexpr auto nano = size_t(1'000'000'000);
 
 struct Player {
     GstElement* pipeline;
+    MmapSource* source;
     double      rate = 1.0;
 
     auto set_state(GstState state) -> bool;
@@ -105,14 +107,18 @@ auto process_command(Player& player, const std::span<const std::string_view> arg
     } else if(command == "pos") {
         unwrap(pos, player.query_pos());
         std::println("{}s", pos);
+    } else if(command == "stats") {
+        const auto stats = player.source->collect_stats();
+        std::println("requests={} seeks={} hit-pages={} miss-pages={} io-wait={}ms readahead={}KiB",
+                     stats.requests, stats.seeks, stats.hit_pages, stats.miss_pages, stats.io_wait / GST_MSECOND, stats.readahead / 1024);
     } else {
         bail("unknown command");
     }
     return true;
 }
 
-auto cli(GstElement* pipeline) -> bool {
-    auto player = Player{pipeline};
+auto cli(GstElement* pipeline, MmapSource& source) -> bool {
+    auto player = Player{pipeline, &source};
     auto line   = std::string();
 loop:
     std::print("> ");
@@ -142,25 +148,27 @@ auto main(const int argc, const char* const* argv) -> int {
 
     gst_init(NULL, NULL);
 
+    // buffers point into the mapping, so the source must be destroyed after the pipeline
+    auto       source   = MmapSource();
     const auto pipeline = AutoGstObject(gst_pipeline_new(NULL));
     ensure(pipeline);
 
-    // filesrc -> qtdemux -> h264parse -> avdec_h264 -> videoconvert ! waylandsink
-    unwrap_mut(filesrc, add_new_element_to_pipeline(pipeline.get(), "filesrc"));
-    g_object_set(&filesrc, "location", video_file, NULL);
+    // appsrc(mmap) -> qtdemux -> h264parse -> avdec_h264 -> videoconvert ! waylandsink
+    unwrap_mut(appsrc, add_new_element_to_pipeline(pipeline.get(), "appsrc"));
+    ensure(source.init(&appsrc, video_file));
     unwrap_mut(qtdemux, add_new_element_to_pipeline(pipeline.get(), "qtdemux"));
     unwrap_mut(avdec_h264, add_new_element_to_pipeline(pipeline.get(), "avdec_h264"));
     unwrap_mut(videoconvert, add_new_element_to_pipeline(pipeline.get(), "videoconvert"));
     unwrap_mut(waylandsink, add_new_element_to_pipeline(pipeline.get(), "waylandsink"));
 
-    ensure(gst_element_link_pads(&filesrc, NULL, &qtdemux, NULL) == TRUE);
+    ensure(gst_element_link_pads(&appsrc, NULL, &qtdemux, NULL) == TRUE);
     g_signal_connect(&qtdemux, "pad-added", G_CALLBACK(link_pads_simple), &avdec_h264);
     ensure(gst_element_link_pads(&avdec_h264, NULL, &videoconvert, NULL) == TRUE);
     ensure(gst_element_link_pads(&videoconvert, NULL, &waylandsink, NULL) == TRUE);
 
     std::println("state: {}", std::to_underlying(gst_element_set_state(pipeline.get(), GST_STATE_PLAYING)));
 
-    cli(pipeline.get());
+    cli(pipeline.get(), source);
 
     ensure(gst_element_set_state(pipeline.get(), GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
 
@@ -40,5 +40,12 @@ struct AutoGstObject {
             gst_object_ref_sink(ptr);
         }
     }
+
+    // takes over a reference which is not floating, e.g. from gst_element_request_pad_simple()
+    static auto adopt(T* const ptr) -> AutoGstObject {
+        auto ret = AutoGstObject();
+        ret.ptr.reset(ptr);
+        return ret;
+    }
 };
 
@@ -0,0 +1,298 @@
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <print>
+#include <string_view>
+#include <utility>
+
+#include "auto-gst-object.hpp"
+#include "branch-supervisor.hpp"
+#include "error.hpp"
+#include "macros/assert.hpp"
+
+struct BranchSupervisor::Branch {
+    enum class State {
+        Running,
+        Dropping,  // failed, the junction drops buffers while the branch is rebuilt
+        Relinking, // rebuilt, the junction links it on the next buffer
+    };
+
+    BranchSupervisor*     supervisor;
+    std::string           name;
+    AutoGstObject<GstPad> junction;
+    Builder               build;
+    // guarded by supervisor->lock
+    std::vector<GstElement*> elements;
+    std::vector<GstElement*> dying;
+    AutoGError               error;
+    State                    state           = State::Running;
+    GstClockTime             error_at        = 0;
+    GstClockTime             window_start    = 0;
+    size_t                   window_restarts = 0;
+    size_t                   restarts        = 0;
+    GstClockTime             last_recovery   = 0;
+    GstClockTime             total_recovery  = 0;
+
+    auto contains(GstObject* object) const -> bool;
+    auto construct() -> bool;
+    auto link() -> bool;
+    auto destruct() -> bool;
+};
+
+auto BranchSupervisor::Branch::contains(GstObject* const object) const -> bool {
+    for(const auto list : {&elements, &dying}) {
+        for(const auto elem : *list) {
+            if(object == GST_OBJECT(elem) || gst_object_has_as_ancestor(object, GST_OBJECT(elem)) == TRUE) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+namespace {
+auto list_children(GstElement* const bin) -> std::vector<GstElement*> {
+    auto ret = std::vector<GstElement*>();
+    GST_OBJECT_LOCK(bin);
+    for(auto l = GST_BIN_CHILDREN(bin); l != NULL; l = l->next) {
+        ret.push_back(GST_ELEMENT(l->data));
+    }
+    GST_OBJECT_UNLOCK(bin);
+    return ret;
+}
+
+auto is_queue(GstElement* const element) -> bool {
+    const auto factory = gst_element_get_factory(element);
+    return factory != NULL && std::string_view(gst_plugin_feature_get_name(GST_PLUGIN_FEATURE(factory))) == "queue";
+}
+} // namespace
+
+// the lock is not held while changing states, since it may post messages or join streaming threads
+// which are waiting for the bus handler
+
+// builds the branch and brings it to the pipeline state, without linking it to the junction
+auto BranchSupervisor::Branch::construct() -> bool {
+    const auto before = list_children(supervisor->pipeline);
+    auto       built  = build(supervisor->pipeline);
+    if(!built || built->empty()) {
+        // the builder may have added some elements before failing
+        for(const auto elem : list_children(supervisor->pipeline)) {
+            if(std::ranges::find(before, elem) == before.end()) {
+                gst_element_set_state(elem, GST_STATE_NULL);
+                gst_bin_remove(GST_BIN(supervisor->pipeline), elem);
+            }
+        }
+        PRINT("builder of branch {} failed", name);
+        return false;
+    }
+    {
+        auto guard = std::lock_guard(supervisor->lock);
+        elements   = *built;
+    }
+
+    if(!is_queue(built->front())) {
+        PRINT("branch {} must start with a queue", name);
+        return false;
+    }
+    // downstream first, so that no element receives data before its peer is ready
+    for(auto it = built->rbegin(); it != built->rend(); it += 1) {
+        ensure(gst_element_sync_state_with_parent(*it) == TRUE);
+    }
+    return true;
+}
+
+// while streaming, only call this from the junction probe, so that sticky events are resent before the next buffer
+auto BranchSupervisor::Branch::link() -> bool {
+    const auto sink_pad = AutoGstObject<GstPad>::adopt(gst_element_get_static_pad(elements.front(), "sink"));
+    ensure(sink_pad.get() != NULL);
+    ensure(gst_pad_link(junction.get(), sink_pad.get()) == GST_PAD_LINK_OK);
+    return true;
+}
+
+auto BranchSupervisor::Branch::destruct() -> bool {
+    {
+        auto guard = std::lock_guard(supervisor->lock);
+        dying      = std::exchange(elements, {});
+    }
+    if(const auto peer = gst_pad_get_peer(junction.get()); peer != NULL) {
+        gst_pad_unlink(junction.get(), peer);
+        gst_object_unref(peer);
+    }
+    for(const auto elem : dying) {
+        // an element in error state may fail to change state, keep going to remove the rest
+        gst_element_set_state(elem, GST_STATE_NULL);
+    }
+    auto removing = std::vector<GstElement*>();
+    {
+        auto guard = std::lock_guard(supervisor->lock);
+        removing   = std::exchange(dying, {});
+    }
+    for(const auto elem : removing) {
+        ensure(gst_bin_remove(GST_BIN(supervisor->pipeline), elem) == TRUE);
+    }
+    return true;
+}
+
+namespace {
+using State = BranchSupervisor::Branch::State;
+
+// stays on the junction for the whole lifetime of the branch, so that the upstream thread never waits for a rebuild
+auto junction_probe_callback(GstPad* const /*pad*/, GstPadProbeInfo* const /*info*/, gpointer const data) -> GstPadProbeReturn {
+    auto& branch = *std::bit_cast<BranchSupervisor::Branch*>(data);
+    auto  error  = AutoGError();
+    {
+        auto guard = std::lock_guard(branch.supervisor->lock);
+        switch(branch.state) {
+        case State::Running:
+            return GST_PAD_PROBE_OK;
+        case State::Dropping:
+            return GST_PAD_PROBE_DROP;
+        case State::Relinking:
+            branch.state = State::Running;
+            if(branch.link()) {
+                // the sticky events were already checked for this buffer, so drop it and let the next one carry them
+                return GST_PAD_PROBE_DROP;
+            }
+            error = std::move(branch.error);
+            break;
+        }
+    }
+    // posted without the lock, since the bus handler takes it
+    const auto pipeline = branch.supervisor->pipeline;
+    const auto debug    = std::format("branch {} could not be relinked", branch.name);
+    PRINT("{}", debug);
+    gst_element_post_message(pipeline, gst_message_new_error(GST_OBJECT(pipeline), error.get(), debug.data()));
+    return GST_PAD_PROBE_DROP;
+}
+
+// runs on a thread of the pipeline's pool, the rest of the pipeline keeps streaming meanwhile
+auto rebuild_branch(GstElement* const /*pipeline*/, gpointer const data) -> void {
+    auto& branch = *std::bit_cast<BranchSupervisor::Branch*>(data);
+    PRINT("rebuilding branch {}", branch.name);
+    if(!branch.destruct() || !branch.construct()) {
+        // remove partially built elements, then escalate the original error
+        branch.destruct();
+        auto error = AutoGError();
+        {
+            auto guard   = std::lock_guard(branch.supervisor->lock);
+            branch.state = State::Running;
+            error        = std::move(branch.error);
+        }
+        const auto pipeline = branch.supervisor->pipeline;
+        const auto debug    = std::format("branch {} could not be rebuilt", branch.name);
+        PRINT("{}", debug);
+        gst_element_post_message(pipeline, gst_message_new_error(GST_OBJECT(pipeline), error.get(), debug.data()));
+        return;
+    }
+    auto guard           = std::lock_guard(branch.supervisor->lock);
+    branch.last_recovery = gst_util_get_timestamp() - branch.error_at;
+    branch.total_recovery += branch.last_recovery;
+    branch.state = State::Relinking;
+    PRINT("branch {} rebuilt in {}ms", branch.name, branch.last_recovery / GST_MSECOND);
+}
+
+// called from the thread which posted the message, before the junction pushes again
+auto bus_sync_handler(GstBus* const /*bus*/, GstMessage* const msg, gpointer const data) -> GstBusSyncReply {
+    if(GST_MESSAGE_TYPE(msg) != GST_MESSAGE_ERROR) {
+        return GST_BUS_PASS;
+    }
+    auto& self  = *std::bit_cast<BranchSupervisor*>(data);
+    auto  guard = std::lock_guard(self.lock);
+    for(const auto& branch : self.branches) {
+        if(!branch->contains(msg->src)) {
+            continue;
+        }
+        if(branch->state != State::Running) {
+            // errors from the dying elements
+            return GST_BUS_DROP;
+        }
+        const auto now = gst_util_get_timestamp();
+        if(now - branch->window_start > self.restart_window) {
+            branch->window_start    = now;
+            branch->window_restarts = 0;
+        }
+        if(branch->window_restarts >= self.max_restarts) {
+            PRINT("branch {} exceeded max restarts", branch->name);
+            return GST_BUS_PASS;
+        }
+        auto [err, str] = parse_message_to_error(msg);
+        PRINT("error in branch {} from {}: {}", branch->name, GST_OBJECT_NAME(msg->src), err->message);
+        branch->state    = State::Dropping;
+        branch->error_at = now;
+        branch->error    = std::move(err);
+        branch->window_restarts += 1;
+        branch->restarts += 1;
+        gst_element_call_async(self.pipeline, rebuild_branch, branch.get(), NULL);
+        return GST_BUS_DROP;
+    }
+    return GST_BUS_PASS;
+}
+} // namespace
+
+auto BranchSupervisor::add_branch(std::string name, GstPad* const junction, Builder build) -> bool {
+    auto branch = new Branch{
+        .supervisor = this,
+        .name       = std::move(name),
+        .junction   = AutoGstObject<GstPad>::adopt(junction),
+        .build      = std::move(build),
+    };
+    {
+        auto guard = std::lock_guard(lock);
+        branches.emplace_back(branch);
+    }
+    if(!branch->construct() || !branch->link()) {
+        branch->destruct();
+        return false;
+    }
+    const auto type = GstPadProbeType(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST);
+    ensure(gst_pad_add_probe(branch->junction.get(), type, junction_probe_callback, branch, NULL) != 0);
+    return true;
+}
+
+auto BranchSupervisor::attach() -> bool {
+    const auto bus = AutoGstObject<GstBus>::adopt(gst_element_get_bus(pipeline));
+    ensure(bus.get() != NULL);
+    gst_bus_set_sync_handler(bus.get(), bus_sync_handler, this, NULL);
+    return true;
+}
+
+auto BranchSupervisor::collect_counters() -> std::vector<Counters> {
+    auto guard = std::lock_guard(lock);
+    auto ret   = std::vector<Counters>();
+    for(const auto& branch : branches) {
+        ret.push_back(Counters{
+            .name           = branch->name,
+            .restarts       = branch->restarts,
+            .last_recovery  = branch->last_recovery,
+            .total_recovery = branch->total_recovery,
+        });
+    }
+    return ret;
+}
+
+auto BranchSupervisor::print_counters() -> void {
+    for(const auto& counters : collect_counters()) {
+        std::println("{}: restarts={} last={}ms total={}ms",
+                     counters.name, counters.restarts, counters.last_recovery / GST_MSECOND, counters.total_recovery / GST_MSECOND);
+    }
+}
+
+BranchSupervisor::BranchSupervisor(GstElement* const pipeline)
+    : pipeline(pipeline) {}
+
+BranchSupervisor::~BranchSupervisor() {
+    if(const auto bus = AutoGstObject<GstBus>::adopt(gst_element_get_bus(pipeline)); bus) {
+        gst_bus_set_sync_handler(bus.get(), NULL, NULL, NULL);
+    }
+    for(const auto& branch : branches) {
+        const auto pad   = branch->junction.get();
+        const auto templ = GST_PAD_PAD_TEMPLATE(pad);
+        if(templ == NULL || GST_PAD_TEMPLATE_PRESENCE(templ) != GST_PAD_REQUEST) {
+            continue;
+        }
+        if(const auto parent = gst_pad_get_parent_element(pad); parent != NULL) {
+            gst_element_release_request_pad(parent, pad);
+            gst_object_unref(parent);
+        }
+    }
+}
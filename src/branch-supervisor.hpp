@@ -0,0 +1,50 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <gst/gst.h>
+
+// rebuilds only the branch that posted an error, while the rest of the pipeline keeps running
+// each branch is fed by a junction pad (e.g. a tee with allow-not-linked) and must start with a queue.
+// on error, the junction drops buffers for the branch, the branch is rebuilt on another thread,
+// and the junction links the new branch on the next buffer.
+// limitation: a push which passed the junction just before the error was posted still receives
+// the flow error, which stops the upstream element and thus the whole pipeline.
+// if a branch cannot be rebuilt, an error is posted from the pipeline so that run_pipeline() stops.
+struct BranchSupervisor {
+    // creates the branch elements, adds them to the pipeline and links them to each other
+    // returns the elements in stream order, the first one is linked to the junction
+    using Builder = std::function<std::optional<std::vector<GstElement*>>(GstElement* pipeline)>;
+
+    struct Branch;
+
+    struct Counters {
+        std::string  name;
+        size_t       restarts;
+        GstClockTime last_recovery;
+        GstClockTime total_recovery;
+    };
+
+    // a branch failing more than max_restarts times within restart_window stops the pipeline
+    // the window restarts at the first error after it has elapsed, so rare failures are always recovered
+    size_t       max_restarts   = 5;
+    GstClockTime restart_window = 60 * GST_SECOND;
+
+    GstElement*                          pipeline;
+    std::mutex                           lock;
+    std::vector<std::unique_ptr<Branch>> branches;
+
+    // takes over the reference to junction, request pads are released on destruction
+    auto add_branch(std::string name, GstPad* junction, Builder build) -> bool;
+    // install the bus handler, call before run_pipeline()
+    auto attach() -> bool;
+    auto collect_counters() -> std::vector<Counters>;
+    auto print_counters() -> void;
+
+    BranchSupervisor(GstElement* pipeline);
+    ~BranchSupervisor();
+};
@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <bit>
+#include <map>
+#include <print>
+
+#include "auto-gst-object.hpp"
+#include "latency-tracer.hpp"
+#include "macros/assert.hpp"
+
+namespace {
+// keep percentiles over a recent window so that long live runs do not grow unbounded
+constexpr auto max_samples = size_t(4096);
+constexpr auto max_recent  = size_t(256);
+
+struct Samples {
+    std::vector<GstClockTime> data;
+    size_t                    head = 0;
+
+    auto push(const GstClockTime value) -> void {
+        if(data.size() < max_samples) {
+            data.push_back(value);
+        } else {
+            data[head] = value;
+            head       = (head + 1) % max_samples;
+        }
+    }
+
+    auto stats() const -> LatencyStats {
+        if(data.empty()) {
+            return {};
+        }
+        auto sorted = data;
+        std::ranges::sort(sorted);
+        const auto at = [&sorted](const size_t percent) {
+            // nearest-rank
+            const auto rank = (sorted.size() * percent + 99) / 100;
+            return sorted[std::max(rank, size_t(1)) - 1];
+        };
+        return LatencyStats{
+            .count = sorted.size(),
+            .p50   = at(50),
+            .p90   = at(90),
+            .p99   = at(99),
+            .max   = sorted.back(),
+        };
+    }
+};
+
+auto to_ms(const GstClockTime time) -> double {
+    return double(time) / GST_MSECOND;
+}
+
+auto print_stats(const char* const kind, const LatencyStats& stats) -> void {
+    std::println("  {:5} n={} p50={:.2f}ms p90={:.2f}ms p99={:.2f}ms max={:.2f}ms",
+                 kind, stats.count, to_ms(stats.p50), to_ms(stats.p90), to_ms(stats.p99), to_ms(stats.max));
+}
+} // namespace
+
+struct LatencyTracer::Point {
+    LatencyTracer* tracer;
+    size_t         index;
+    std::string    label;
+    Samples        hop;
+    Samples        total;
+    size_t         missing = 0;
+    // stamp -> elapsed, so that the next point can compute its hop latency
+    std::map<GstClockTime, GstClockTime> recent;
+
+    auto on_buffer(GstBuffer* buffer, GstClockTime now) -> void;
+};
+
+auto LatencyTracer::Point::on_buffer(GstBuffer* const buffer, const GstClockTime now) -> void {
+    const auto meta = gst_buffer_get_reference_timestamp_meta(buffer, tracer->reference);
+
+    auto guard = std::lock_guard(tracer->lock);
+    if(meta == NULL) {
+        missing += 1;
+        return;
+    }
+    // payloaders split one frame into many buffers carrying the same stamp, count the first one only
+    const auto stamp = meta->timestamp;
+    if(recent.contains(stamp)) {
+        return;
+    }
+    const auto elapsed = now - stamp;
+    recent.emplace(stamp, elapsed);
+    if(recent.size() > max_recent) {
+        recent.erase(recent.begin());
+    }
+    total.push(elapsed);
+    if(index == 0) {
+        hop.push(elapsed);
+    } else {
+        const auto& prev = tracer->points[index - 1]->recent;
+        if(const auto it = prev.find(stamp); it != prev.end() && it->second <= elapsed) {
+            hop.push(elapsed - it->second);
+        }
+    }
+}
+
+namespace {
+auto stamp_probe_callback(GstPad* const /*pad*/, GstPadProbeInfo* const info, gpointer const data) -> GstPadProbeReturn {
+    auto& self   = *std::bit_cast<LatencyTracer*>(data);
+    auto  buffer = gst_buffer_make_writable(GST_PAD_PROBE_INFO_BUFFER(info));
+    gst_buffer_add_reference_timestamp_meta(buffer, self.reference, gst_util_get_timestamp(), GST_CLOCK_TIME_NONE);
+    GST_PAD_PROBE_INFO_DATA(info) = buffer;
+    return GST_PAD_PROBE_OK;
+}
+
+auto measure_probe_callback(GstPad* const /*pad*/, GstPadProbeInfo* const info, gpointer const data) -> GstPadProbeReturn {
+    auto&      point = *std::bit_cast<LatencyTracer::Point*>(data);
+    const auto now   = gst_util_get_timestamp();
+    if(info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+        const auto list = GST_PAD_PROBE_INFO_BUFFER_LIST(info);
+        for(auto i = 0u; i < gst_buffer_list_length(list); i += 1) {
+            point.on_buffer(gst_buffer_list_get(list, i), now);
+        }
+    } else {
+        point.on_buffer(GST_PAD_PROBE_INFO_BUFFER(info), now);
+    }
+    return GST_PAD_PROBE_OK;
+}
+} // namespace
+
+auto LatencyTracer::stamp_at(GstElement* const element, const char* const pad_name) -> bool {
+    const auto pad = AutoGstObject(gst_element_get_static_pad(element, pad_name));
+    ensure(pad.get() != NULL);
+    ensure(gst_pad_add_probe(pad.get(), GST_PAD_PROBE_TYPE_BUFFER, stamp_probe_callback, this, NULL) != 0);
+    return true;
+}
+
+auto LatencyTracer::measure_at(GstElement* const element, const char* const pad_name, std::string label) -> bool {
+    const auto pad = AutoGstObject(gst_element_get_static_pad(element, pad_name));
+    ensure(pad.get() != NULL);
+
+    auto guard = std::lock_guard(lock);
+    auto point = new Point{
+        .tracer = this,
+        .index  = points.size(),
+        .label  = std::move(label),
+    };
+    points.emplace_back(point);
+    const auto type = GstPadProbeType(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST);
+    ensure(gst_pad_add_probe(pad.get(), type, measure_probe_callback, point, NULL) != 0);
+    return true;
+}
+
+auto LatencyTracer::copy_stamp(GstBuffer* const from, GstBuffer* const to) const -> void {
+    if(const auto meta = gst_buffer_get_reference_timestamp_meta(from, reference); meta != NULL) {
+        gst_buffer_add_reference_timestamp_meta(to, meta->reference, meta->timestamp, meta->duration);
+    }
+}
+
+auto LatencyTracer::collect_report() -> LatencyReport {
+    auto guard  = std::lock_guard(lock);
+    auto report = LatencyReport();
+    for(const auto& point : points) {
+        report.entries.push_back(LatencyReport::Entry{
+            .label   = point->label,
+            .hop     = point->hop.stats(),
+            .total   = point->total.stats(),
+            .missing = point->missing,
+        });
+    }
+    return report;
+}
+
+auto LatencyTracer::print_report() -> void {
+    const auto report = collect_report();
+    for(const auto& entry : report.entries) {
+        std::println("{} (unstamped={})", entry.label, entry.missing);
+        print_stats("hop", entry.hop);
+        print_stats("total", entry.total);
+    }
+}
+
+LatencyTracer::LatencyTracer()
+    : reference(gst_caps_new_empty_simple("timestamp/x-gstutil-latency")) {}
+
+LatencyTracer::~LatencyTracer() {
+    gst_caps_unref(reference);
+}
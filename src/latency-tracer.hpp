@@ -0,0 +1,46 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <gst/gst.h>
+
+struct LatencyStats {
+    size_t       count = 0;
+    GstClockTime p50   = 0;
+    GstClockTime p90   = 0;
+    GstClockTime p99   = 0;
+    GstClockTime max   = 0;
+};
+
+struct LatencyReport {
+    struct Entry {
+        std::string  label;
+        LatencyStats hop;   // since the previous measure point
+        LatencyStats total; // since the stamp point
+        size_t       missing;
+    };
+
+    std::vector<Entry> entries;
+};
+
+// stamps buffers with GstReferenceTimestampMeta at one pad and reads them back at downstream pads
+// measure points must be added in stream order, since hop latency is computed against the previous one
+struct LatencyTracer {
+    struct Point;
+
+    GstCaps*                            reference;
+    std::mutex                          lock;
+    std::vector<std::unique_ptr<Point>> points;
+
+    auto stamp_at(GstElement* element, const char* pad_name) -> bool;
+    auto measure_at(GstElement* element, const char* pad_name, std::string label) -> bool;
+    // metas are not carried over by hand-made buffers, e.g. appsink -> appsrc
+    auto copy_stamp(GstBuffer* from, GstBuffer* to) const -> void;
+    auto collect_report() -> LatencyReport;
+    auto print_report() -> void;
+
+    LatencyTracer();
+    ~LatencyTracer();
+};
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <bit>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gst/app/gstappsrc.h>
+
+#include "macros/assert.hpp"
+#include "mmap-source.hpp"
+
+namespace {
+constexpr auto min_readahead   = size_t(256 * 1024);
+constexpr auto max_readahead   = size_t(8 * 1024 * 1024);
+constexpr auto default_request = size_t(4096);
+const auto     page_size       = size_t(sysconf(_SC_PAGESIZE));
+
+auto align_down(const size_t value) -> size_t {
+    return value / page_size * page_size;
+}
+
+auto on_need_data(GstAppSrc* const /*appsrc*/, const guint length, const gpointer data) -> void {
+    std::bit_cast<MmapSource*>(data)->on_need_data(length);
+}
+
+auto on_seek_data(GstAppSrc* const /*appsrc*/, const guint64 offset, const gpointer data) -> gboolean {
+    return std::bit_cast<MmapSource*>(data)->on_seek_data(offset) ? TRUE : FALSE;
+}
+} // namespace
+
+auto MmapSource::init(GstElement* const appsrc, const char* const path) -> bool {
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    ensure(fd >= 0);
+    struct stat st = {};
+    ensure(fstat(fd, &st) == 0);
+    size = size_t(st.st_size);
+    ensure(size > 0);
+    const auto ptr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ensure(ptr != MAP_FAILED);
+    data = std::bit_cast<std::byte*>(ptr);
+    // read-ahead is driven by us, keep the kernel from guessing on faults
+    madvise(data, size, MADV_RANDOM);
+
+    this->appsrc    = appsrc;
+    stats.readahead = min_readahead;
+    g_object_set(appsrc,
+                 "stream-type", GST_APP_STREAM_TYPE_RANDOM_ACCESS,
+                 "format", GST_FORMAT_BYTES,
+                 "size", gint64(size),
+                 NULL);
+    ensure(g_signal_connect(appsrc, "need-data", G_CALLBACK(::on_need_data), this) > 0);
+    ensure(g_signal_connect(appsrc, "seek-data", G_CALLBACK(::on_seek_data), this) > 0);
+    return true;
+}
+
+auto MmapSource::on_need_data(size_t length) -> void {
+    auto request = size_t();
+    {
+        auto guard = std::lock_guard(lock);
+        if(offset >= size) {
+            gst_app_src_end_of_stream(GST_APP_SRC(appsrc));
+            return;
+        }
+        length  = std::min(length > 0 ? length : default_request, size - offset);
+        request = offset;
+        offset += length;
+        stats.requests += 1;
+
+        // keep the window ahead of the playhead
+        // refilling only happens while reads stay sequential, so grow it each time
+        if(prefetched < request + length + stats.readahead / 2) {
+            const auto begin = align_down(std::max(request, prefetched));
+            const auto end   = std::min(request + length + stats.readahead, size);
+            if(begin < end) {
+                madvise(data + begin, end - begin, MADV_WILLNEED);
+            }
+            prefetched      = end;
+            stats.readahead = std::min(stats.readahead * 2, max_readahead);
+        }
+    }
+
+    // check residency, then fault the missing pages in here so that the wait is accounted
+    // the lock is not held, so that collect_stats() does not wait for the I/O
+    const auto begin    = align_down(request);
+    const auto pages    = (request + length - begin + page_size - 1) / page_size;
+    auto       resident = std::vector<unsigned char>(pages);
+    auto       misses   = size_t(0);
+    auto       io_wait  = GstClockTime(0);
+    const auto checked  = mincore(data + begin, request + length - begin, resident.data()) == 0;
+    if(checked) {
+        for(const auto r : resident) {
+            misses += (r & 1) == 0 ? 1 : 0;
+        }
+        if(misses > 0) {
+            const auto start = gst_util_get_timestamp();
+            for(auto i = size_t(0); i < pages; i += 1) {
+                if((resident[i] & 1) == 0) {
+                    static_cast<void>(*std::bit_cast<volatile std::byte*>(data + begin + i * page_size));
+                }
+            }
+            io_wait = gst_util_get_timestamp() - start;
+        }
+    }
+    if(checked) {
+        auto guard = std::lock_guard(lock);
+        stats.hit_pages += pages - misses;
+        stats.miss_pages += misses;
+        stats.io_wait += io_wait;
+    }
+
+    // zero-copy, the buffer points into the mapping
+    const auto buffer             = gst_buffer_new_wrapped_full(GST_MEMORY_FLAG_READONLY, data + request, length, 0, length, NULL, NULL);
+    GST_BUFFER_OFFSET(buffer)     = request;
+    GST_BUFFER_OFFSET_END(buffer) = request + length;
+    gst_app_src_push_buffer(GST_APP_SRC(appsrc), buffer);
+}
+
+auto MmapSource::on_seek_data(const size_t target) -> bool {
+    auto guard = std::lock_guard(lock);
+    ensure(target <= size);
+    // demuxers in pull mode skip over samples of other tracks, which is still sequential playback
+    if(target >= offset && target < std::max(prefetched, offset + min_readahead)) {
+        offset = target;
+        return true;
+    }
+    stats.seeks += 1;
+    offset = target;
+    // restart the window, and prefetch the seek target right away
+    stats.readahead = min_readahead;
+    prefetched      = std::min(target + min_readahead, size);
+    madvise(data + align_down(target), prefetched - align_down(target), MADV_WILLNEED);
+    return true;
+}
+
+auto MmapSource::collect_stats() -> MmapSourceStats {
+    auto guard = std::lock_guard(lock);
+    return stats;
+}
+
+MmapSource::~MmapSource() {
+    if(data != nullptr) {
+        munmap(data, size);
+    }
+    if(fd >= 0) {
+        close(fd);
+    }
+}
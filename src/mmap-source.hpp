@@ -0,0 +1,33 @@
+#pragma once
+#include <mutex>
+
+#include <gst/gst.h>
+
+struct MmapSourceStats {
+    size_t       requests   = 0;
+    size_t       seeks      = 0; // jumps outside the read-ahead window
+    size_t       hit_pages  = 0; // already resident when requested
+    size_t       miss_pages = 0;
+    GstClockTime io_wait    = 0; // time spent faulting in missed pages
+    size_t       readahead  = 0; // current window size in bytes
+};
+
+// serves a file to a random-access appsrc from an mmap-ed region, with adaptive read-ahead around the playhead
+// buffers point into the mapping, so this must outlive the pipeline streaming
+struct MmapSource {
+    GstElement*     appsrc     = nullptr;
+    int             fd         = -1;
+    std::byte*      data       = nullptr;
+    size_t          size       = 0;
+    size_t          offset     = 0;
+    size_t          prefetched = 0; // [offset, prefetched) has been advised to the kernel
+    std::mutex      lock;
+    MmapSourceStats stats;
+
+    auto init(GstElement* appsrc, const char* path) -> bool;
+    auto on_need_data(size_t length) -> void;
+    auto on_seek_data(size_t target) -> bool;
+    auto collect_stats() -> MmapSourceStats;
+
+    ~MmapSource();
+};
@@ -23,11 +23,13 @@ auto run_pipeline(GstElement* const pipeline) -> bool {
                                                                GST_CLOCK_TIME_NONE,
                                                                GstMessageType(GST_MESSAGE_ERROR | GST_MESSAGE_EOS)));
     ensure(msg.get() != NULL);
+    auto ok = true;
     switch(GST_MESSAGE_TYPE(msg.get())) {
     case GST_MESSAGE_ERROR: {
         auto [err, str] = parse_message_to_error(msg.get());
         g_printerr("Error received from element %s: %s\n", GST_OBJECT_NAME(msg->src), err->message);
         g_printerr("Debugging information: %s\n", str ? str.get() : "none");
+        ok = false;
     } break;
     case GST_MESSAGE_EOS:
         g_print("End-Of-Stream reached.\n");
@@ -38,7 +40,7 @@ auto run_pipeline(GstElement* const pipeline) -> bool {
     }
 
     ensure(gst_element_set_state(pipeline, GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
-    return true;
+    return ok;
 }
 
 auto post_eos(GstElement* const pipeline) -> bool {
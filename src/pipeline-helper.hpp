@@ -2,5 +2,6 @@
 #include <gst/gst.h>
 
 auto add_new_element_to_pipeline(GstElement* const pipeline, const char* const element_name) -> GstElement*;
+// returns false if the pipeline stopped by an error
 auto run_pipeline(GstElement* pipeline) -> bool;
 auto post_eos(GstElement* pipeline) -> bool;